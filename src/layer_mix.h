@@ -0,0 +1,45 @@
+// Layer combining for the priority mixer. Kept free of Arduino dependencies
+// so tools/mix_bench.cpp can build and time the exact same pass on a host.
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+#ifndef MAX_DMX_CHANNELS
+#define MAX_DMX_CHANNELS 512
+#endif
+
+enum LayerMode { LAYER_LTP, LAYER_HTP };
+
+struct Layer {
+    uint8_t values[MAX_DMX_CHANNELS];
+    uint8_t mask[MAX_DMX_CHANNELS];  // 0xFF where the layer owns the channel, 0 otherwise
+    uint8_t mode;                    // LAYER_LTP or LAYER_HTP
+    uint8_t opacity;                 // Crossfade master, 0-255
+    uint8_t priority;                // Higher is combined later (on top)
+    uint16_t length;                 // Channels this layer needs on the wire
+    bool active;
+    bool dirty;
+};
+
+// Combine one layer over the frame below it into out. One linear pass; the
+// mask folds into the per-channel opacity.
+inline void combineLayer(const Layer& layer, const uint8_t* below, uint8_t* out) {
+    if (!layer.active || layer.opacity == 0) {
+        memcpy(out, below, MAX_DMX_CHANNELS);
+        return;
+    }
+
+    const uint8_t* values = layer.values;
+    const uint8_t* mask = layer.mask;
+    const uint8_t opacity = layer.opacity;
+    if (layer.mode == LAYER_HTP) {
+        for (int c = 0; c < MAX_DMX_CHANNELS; ++c) {
+            uint8_t v = (values[c] * (mask[c] & opacity)) / 255;
+            out[c] = v > below[c] ? v : below[c];
+        }
+    } else {
+        for (int c = 0; c < MAX_DMX_CHANNELS; ++c) {
+            out[c] = below[c] + ((values[c] - below[c]) * (mask[c] & opacity)) / 255;
+        }
+    }
+}
@@ -3,9 +3,10 @@
 #include <WiFi.h>
 #include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
-#include <SPIFFS.h>
 #include <Preferences.h>
 #include <WiFiUdp.h>
+#include "web_assets.h"  // Generated from data/ by tools/embed_web.py
+#include "layer_mix.h"
 
 // WiFi credentials in AP Mode (fallback if no other WiFi is available)
 const char* ssid = "DMXController";
@@ -21,13 +22,29 @@ void hsvToRgb(float h, float s, float v, float& r, float& g, float& b);
 void setColor(uint8_t r, uint8_t g, uint8_t b, int fixture = 0);
 void setDimmer(uint8_t value, int fixture = 0);
 void notifyClients();
+struct WsCommand;
+void handleCommand(const WsCommand& command);
+void serveWebAsset(AsyncWebServerRequest *request, const WebAsset& asset);
 void updateDMX();
 void startTransition(int fixture);
 void updateTransition();
+unsigned long dmxFrameMicros(int packetSize);
+bool dmxFrameDue(int packetSize, unsigned long nowMicros);
 void setChannelValue(int channel, uint8_t value, int fixture = 0);
 void setRedManual();
 void setGreenManual();
 void setBlueManual();
+void updateArtnetOutput(unsigned long now);
+void updateSacn(unsigned long now);
+int countSacnSources();
+void initLayers();
+void clearLayer(int layer);
+bool mixLayers();
+bool layersDirty();
+float benchmarkMixer();
+int mixedChannelCount();
+void releaseManual(int idx);
+int countArtnetNodes();
 
 // DMX pins
 #define DMX_TX_PIN 7
@@ -51,7 +68,7 @@ dmx_port_t dmxPort = 1;
 #define CHANNEL_FUNCTION 7
 #define CHANNEL_SPEED 8
 
-// Channel state matrix (per fixture)
+// Scene transition state (per fixture channel), rendered into the scene layer
 struct ChannelState {
     uint8_t currentValue;
     uint8_t targetValue;
@@ -59,8 +76,22 @@ struct ChannelState {
 };
 ChannelState channelStates[MAX_DMX_CHANNELS] = {0};
 
-// DMX buffer for all possible channels
-uint8_t dmxData[MAX_DMX_CHANNELS] = {0};
+// DMX buffer for all possible channels (plus start code)
+uint8_t dmxData[MAX_DMX_CHANNELS + 1] = {0};
+
+// Layered priority mixer. Every layer covers the full universe; the mask says
+// which channels it owns. Layers are combined in priority order, LTP layers
+// crossfade over what is below them by their opacity, HTP layers scale by
+// their opacity and take the highest value (see layer_mix.h).
+enum LayerId { LAYER_BASE, LAYER_SCENE, LAYER_MANUAL, LAYER_ARTNET, LAYER_SACN, LAYER_COUNT };
+Layer layers[LAYER_COUNT];
+
+// Layer ids sorted by priority, and the combined frame after each of them, so
+// a change only recombines the layers from the lowest dirty one upwards
+uint8_t layerOrder[LAYER_COUNT];
+bool layerOrderDirty = true;
+uint8_t layerComposite[LAYER_COUNT][MAX_DMX_CHANNELS];
+const uint8_t* mixedFrame = layerComposite[LAYER_COUNT - 1];
 
 // Scene timing
 #define TRANSITION_STEPS 50  // Number of steps for interpolation
@@ -100,6 +131,19 @@ Button buttons[] = {
 // Global variables
 AsyncWebServer server(80);
 AsyncWebSocket ws("/ws");
+bool notifyPending = false;  // Status goes out from loop() once the layers are mixed
+
+// WebSocket commands arrive on the async_tcp task. They are queued and applied
+// in loop(), so they never race the mixer or the layer arrays.
+#define WS_COMMAND_SIZE 256
+#define WS_COMMAND_QUEUE 8
+struct WsCommand {
+    char message[WS_COMMAND_SIZE];
+    unsigned long receivedAt;  // micros() on arrival, for the command-to-wire latency
+};
+QueueHandle_t wsCommands;
+bool mixBenchmarkPending = false;
+float mixBenchmarkMicros = 0;  // Last benchmarkMixer() result
 
 // Scene variables
 bool isRunningScene = false;
@@ -111,9 +155,6 @@ int chasePosition = 0;
 int transitionStep[MAX_FIXTURES] = {0};
 bool isTransitioning[MAX_FIXTURES] = {false};
 
-// Manual override tracking
-bool manualOverride = false;
-
 // --- Slider UI variables ---
 #define SLIDER_WIDTH 200
 #define SLIDER_HEIGHT 20
@@ -146,29 +187,112 @@ Preferences prefs;
 
 #define NUM_CHANNELS 8
 
-// Add a global variable to track the last measured DMX update interval
-unsigned long lastDMXInterval = 25;
-unsigned long lastDMXUpdateTime = 0;
+// DMX refresh scheduler. A frame occupies the wire for break + MAB + 44us per
+// slot, so short packets can be refreshed much faster than a full universe.
+// In change-driven mode a new render goes out as soon as the wire allows and
+// idle output drops to the keep-alive rate. Continuous mode sends frames
+// back-to-back at the fastest rate the packet length allows. Fixed mode is
+// the original 40Hz output (25ms interval, 5ms loop), kept to compare against.
+#define DMX_SLOT_MICROS 44             // 11 bits at 250 kbaud
+#define DMX_MIN_FRAME_MICROS 1204      // E1.11 minimum break-to-break time
+#define DMX_FRAME_MARGIN_MICROS 100    // Driver turnaround between frames
+#define DMX_KEEPALIVE_DEFAULT_HZ 10
+#define DMX_FIXED_INTERVAL_MICROS 25000
+#define TRANSITION_TICK 5              // Scene transitions advance one step per tick (ms)
+enum DmxMode { DMX_MODE_FIXED, DMX_MODE_CONTINUOUS, DMX_MODE_CHANGE };
+int dmxMode = DMX_MODE_CHANGE;
+int dmxKeepAliveHz = DMX_KEEPALIVE_DEFAULT_HZ;
+bool dmxFrameReady = false;            // A new render is waiting for the wire
+unsigned long dmxFrameReadyAt = 0;     // micros() when that render became ready
+unsigned long lastDMXSend = 0;         // micros() of the last frame
+unsigned long lastDMXInterval = 25000; // Last measured frame interval (us)
+unsigned long lastDMXLatency = 0;      // Render-to-wire time of the last new frame (us)
+
+// Command-to-wire latency: from a WebSocket command arriving until the last
+// slot of the first frame carrying its change is out. Accumulated since the
+// DMX mode was last set.
+bool commandPending = false;           // A command changed a layer, not on the wire yet
+unsigned long commandReceivedAt = 0;   // Arrival of the oldest such command (micros)
+unsigned long cmdLatencySum = 0;       // us
+unsigned long cmdLatencyMax = 0;       // us
+unsigned long cmdLatencyCount = 0;
 
 WiFiUDP artnetUDP;
 const int ARTNET_PORT = 6454;
 bool artnetPassthrough = false;
 unsigned long lastArtnetPacket = 0;
+// Seconds without Art-Net before the network layer is released and the local
+// layers show again. 0 holds the last look until passthrough is turned off,
+// the way a console going away should not black out the rig.
+#define ARTNET_HOLD_MAX 3600
+int artnetHoldSeconds = 0;
+
+// sACN (E1.31) receiver
+WiFiUDP sacnUDP;      // Multicast group of the configured universe
+WiFiUDP sacnSyncUDP;  // Multicast group of the synchronization universe, if different
+const int SACN_PORT = 5568;
+#define SACN_MAX_SOURCES 4
+#define SACN_SOURCE_TIMEOUT 2500  // E1.31 network data loss timeout
+#define SACN_PACKET_SIZE 638      // Full data packet with 512 slots
+bool sacnEnabled = false;
+bool sacnRestart = false;         // Set by commands, handled in updateSacn()
+uint16_t sacnUniverse = 1;
+uint16_t sacnSyncUniverse = 0;    // Currently joined sync universe, 0 = none
+unsigned long lastSacnSync = 0;
+uint8_t sacnBuffer[SACN_PACKET_SIZE];
+
+struct SacnSource {
+    uint8_t cid[16];
+    uint8_t values[MAX_DMX_CHANNELS];  // Last released frame, the only one that is merged
+    uint16_t length;
+    uint8_t held[MAX_DMX_CHANNELS];    // Synchronized frame waiting for its sync packet
+    uint16_t heldLength;
+    uint8_t priority;
+    uint8_t sequence;
+    uint16_t syncAddress;
+    unsigned long lastSeen;
+    bool pending;  // held[] is waiting for the matching sync packet
+    bool active;
+};
+SacnSource sacnSources[SACN_MAX_SOURCES];
 uint8_t artnetBuffer[530]; // Enough for Art-Net DMX packet
 
+// Art-Net output node mode (send the local render to remote Art-Net nodes)
+#define ARTNET_MAX_NODES 16
+#define ARTNET_MAX_UNICAST 8            // More subscribers than this and we broadcast instead
+#define ARTNET_POLL_INTERVAL 3000       // ArtPoll every 3s, as the Art-Net spec asks of controllers
+#define ARTNET_NODE_TIMEOUT 10000       // Forget nodes that stop answering ArtPoll
+#define ARTNET_OUTPUT_INTERVAL 25       // Max 40Hz, keeps WiFi airtime bounded
+#define ARTNET_KEEPALIVE_INTERVAL 1000  // Resend unchanged frames once per second
+
+struct ArtnetNode {
+    IPAddress ip;
+    unsigned long lastSeen;
+    bool active;
+};
+ArtnetNode artnetNodes[ARTNET_MAX_NODES];
+
+bool artnetOutput = false;
+uint16_t artnetOutUniverse = 0;  // 15-bit Port-Address (Net/Sub-Net/Universe)
+uint8_t artnetSequence = 0;
+unsigned long lastArtnetPoll = 0;
+unsigned long lastArtnetOutput = 0;
+uint8_t artnetTxBuffer[18 + DMX_PACKET_SIZE];
+uint8_t artnetLastSent[DMX_PACKET_SIZE];
+uint16_t artnetLastSentLength = 0;
+
 void resetAll() {
     // Stop any running scene
     isRunningScene = false;
     currentScene = 0;
-    // Reset all channels to 0 except dimmer
-    for (int f = 0; f < fixtureCount; ++f) {
-        for (int i = 0; i < 8; i++) {
-            setChannelValue(i + 1, 0, f);  // Set all channels to 0
-        }
-    }
-    manualOverride = false;
+    // Reset all local layers so every channel drops to 0
+    clearLayer(LAYER_BASE);
+    clearLayer(LAYER_SCENE);
+    clearLayer(LAYER_MANUAL);
+    memset(channelStates, 0, sizeof(channelStates));
+    memset(isTransitioning, 0, sizeof(isTransitioning));
     dimmerValue = 0;
-    notifyClients();
+    notifyPending = true;
     drawButtons();
 }
 
@@ -176,114 +300,242 @@ void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventTyp
     if (type == WS_EVT_DATA) {
         AwsFrameInfo *info = (AwsFrameInfo*)arg;
         if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
-            data[len] = 0;
-            String message = (char*)data;
-            Serial.println("Received WebSocket message: " + message);
-
-            // Parse JSON
-            StaticJsonDocument<200> doc;
-            DeserializationError error = deserializeJson(doc, message);
-            if (error) {
-                Serial.println("Failed to parse JSON");
+            // Runs on the async_tcp task: only queue the command, loop() applies it
+            if (len >= WS_COMMAND_SIZE) {
+                Serial.println("WebSocket message too long");
                 return;
             }
+            WsCommand command;
+            memcpy(command.message, data, len);
+            command.message[len] = 0;
+            command.receivedAt = micros();
+            if (xQueueSend(wsCommands, &command, 0) != pdTRUE) {
+                Serial.println("WebSocket command queue full, dropped");
+            }
+        }
+    }
+}
 
-            // Handle different commands
-            if (doc.containsKey("color")) {
-                manualOverride = true;
-                uint8_t r = doc["color"]["r"];
-                uint8_t g = doc["color"]["g"];
-                uint8_t b = doc["color"]["b"];
-                for (int f = 0; f < fixtureCount; ++f) {
-                    setChannelValue(CHANNEL_RED, r, f);
-                    setChannelValue(CHANNEL_GREEN, g, f);
-                    setChannelValue(CHANNEL_BLUE, b, f);
-                }
-            } else if (doc.containsKey("dimmer")) {
-                uint8_t newValue = doc["dimmer"];
-                if (dimmerValue != newValue) {
-                    dimmerValue = newValue;
-                    for (int f = 0; f < fixtureCount; ++f) setDimmer(dimmerValue, f);
-                }
-            } else if (doc.containsKey("white")) {
-                manualOverride = true;
-                uint8_t value = doc["white"];
-                for (int f = 0; f < fixtureCount; ++f) setChannelValue(CHANNEL_WHITE, value, f);
-            } else if (doc.containsKey("strobe")) {
-                uint8_t value = doc["strobe"];
-                for (int f = 0; f < fixtureCount; ++f) setChannelValue(CHANNEL_STROBE, value, f);
-            } else if (doc.containsKey("function")) {
-                manualOverride = true;
-                uint8_t value = doc["function"];
-                for (int f = 0; f < fixtureCount; ++f) setChannelValue(CHANNEL_FUNCTION, value, f);
-            } else if (doc.containsKey("speed")) {
-                manualOverride = true;
-                uint8_t value = doc["speed"];
-                for (int f = 0; f < fixtureCount; ++f) setChannelValue(CHANNEL_SPEED, value, f);
-            } else if (doc.containsKey("transitionSpeed")) {
-                transitionSpeed = doc["transitionSpeed"];
-                Serial.println("Setting transition speed to: " + String(transitionSpeed) + "ms");
-            } else if (doc.containsKey("scene")) {
-                int scene = doc["scene"];
-                startScene(scene);
-            } else if (doc.containsKey("stop")) {
-                stopScene();
-            } else if (doc.containsKey("reset")) {
-                resetAll();
-            } else if (doc.containsKey("fixtureCount")) {
-                int newCount = doc["fixtureCount"];
-                if (newCount >= 1 && newCount <= MAX_FIXTURES) { fixtureCount = newCount; }
-            } else if (doc.containsKey("saveSettings")) {
-                // Save all settings to NVS
-                prefs.begin("dmx", false);
-                prefs.putUInt("dimmer", dimmerValue);
-                prefs.putUInt("fixtures", fixtureCount);
-                prefs.putUInt("trSpeed", transitionSpeed);
-                prefs.putUInt("scene", currentScene);
-                prefs.putUInt("artnet", artnetPassthrough ? 1 : 0);
-                for (int f = 0; f < fixtureCount; ++f) {
-                    for (int i = 0; i < 8; ++i) {
-                        int idx = f * 8 + i;
-                        prefs.putUInt((String("ch") + idx).c_str(), channelStates[idx].currentValue);
-                    }
-                }
-                prefs.end();
-            } else if (doc.containsKey("artnetPassthrough")) {
-                artnetPassthrough = doc["artnetPassthrough"];
-            } else if (doc.containsKey("wifiConfig")) {
-                String newSsid = doc["wifiConfig"]["ssid"] | "";
-                String newPassword = doc["wifiConfig"]["password"] | "";
-                prefs.begin("dmx", false);
-                prefs.putString("wifiSsid", newSsid);
-                prefs.putString("wifiPassword", newPassword);
-                prefs.end();
-                ESP.restart();
+void handleCommand(const WsCommand& command) {
+    String message = command.message;
+    Serial.println("Received WebSocket message: " + message);
+
+    // Parse JSON
+    StaticJsonDocument<200> doc;
+    DeserializationError error = deserializeJson(doc, message);
+    if (error) {
+        Serial.println("Failed to parse JSON");
+        return;
+    }
+
+    // Handle different commands
+    if (doc.containsKey("color")) {
+        uint8_t r = doc["color"]["r"];
+        uint8_t g = doc["color"]["g"];
+        uint8_t b = doc["color"]["b"];
+        for (int f = 0; f < fixtureCount; ++f) {
+            setChannelValue(CHANNEL_RED, r, f);
+            setChannelValue(CHANNEL_GREEN, g, f);
+            setChannelValue(CHANNEL_BLUE, b, f);
+        }
+    } else if (doc.containsKey("dimmer")) {
+        uint8_t newValue = doc["dimmer"];
+        if (dimmerValue != newValue) {
+            dimmerValue = newValue;
+            for (int f = 0; f < fixtureCount; ++f) setDimmer(dimmerValue, f);
+        }
+    } else if (doc.containsKey("white")) {
+        uint8_t value = doc["white"];
+        for (int f = 0; f < fixtureCount; ++f) setChannelValue(CHANNEL_WHITE, value, f);
+    } else if (doc.containsKey("strobe")) {
+        uint8_t value = doc["strobe"];
+        for (int f = 0; f < fixtureCount; ++f) setChannelValue(CHANNEL_STROBE, value, f);
+    } else if (doc.containsKey("function")) {
+        uint8_t value = doc["function"];
+        for (int f = 0; f < fixtureCount; ++f) setChannelValue(CHANNEL_FUNCTION, value, f);
+    } else if (doc.containsKey("speed")) {
+        uint8_t value = doc["speed"];
+        for (int f = 0; f < fixtureCount; ++f) setChannelValue(CHANNEL_SPEED, value, f);
+    } else if (doc.containsKey("transitionSpeed")) {
+        transitionSpeed = doc["transitionSpeed"];
+        Serial.println("Setting transition speed to: " + String(transitionSpeed) + "ms");
+    } else if (doc.containsKey("scene")) {
+        int scene = doc["scene"];
+        startScene(scene);
+    } else if (doc.containsKey("stop")) {
+        stopScene();
+    } else if (doc.containsKey("reset")) {
+        resetAll();
+    } else if (doc.containsKey("release")) {
+        // Hand all channels held by the manual programmer back to the layers below
+        clearLayer(LAYER_MANUAL);
+    } else if (doc.containsKey("benchmarkMixer")) {
+        mixBenchmarkPending = true;  // Runs in loop(), not on the network task
+    } else if (doc.containsKey("layer")) {
+        // {"layer": {"id": 1, "opacity": 128, "mode": "htp", "priority": 15}}
+        int id = doc["layer"]["id"] | -1;
+        if (id >= 0 && id < LAYER_COUNT) {
+            Layer& layer = layers[id];
+            if (doc["layer"].containsKey("opacity")) layer.opacity = doc["layer"]["opacity"];
+            if (doc["layer"].containsKey("mode")) layer.mode = doc["layer"]["mode"] == "htp" ? LAYER_HTP : LAYER_LTP;
+            if (doc["layer"].containsKey("priority")) {
+                layer.priority = doc["layer"]["priority"];
+                layerOrderDirty = true;
+            }
+            layer.dirty = true;
+        }
+    } else if (doc.containsKey("fixtureCount")) {
+        int newCount = doc["fixtureCount"];
+        if (newCount >= 1 && newCount <= MAX_FIXTURES) { fixtureCount = newCount; }
+    } else if (doc.containsKey("saveSettings")) {
+        // Save all settings to NVS
+        prefs.begin("dmx", false);
+        prefs.putUInt("dimmer", dimmerValue);
+        prefs.putUInt("fixtures", fixtureCount);
+        prefs.putUInt("trSpeed", transitionSpeed);
+        prefs.putUInt("scene", currentScene);
+        prefs.putUInt("artnet", artnetPassthrough ? 1 : 0);
+        prefs.putUInt("artnetOut", artnetOutput ? 1 : 0);
+        prefs.putUInt("artnetUni", artnetOutUniverse);
+        prefs.putUInt("artnetHold", artnetHoldSeconds);
+        prefs.putUInt("sacn", sacnEnabled ? 1 : 0);
+        prefs.putUInt("sacnUni", sacnUniverse);
+        prefs.putUInt("dmxMode", dmxMode);
+        prefs.putUInt("dmxKeep", dmxKeepAliveHz);
+        for (int f = 0; f < fixtureCount; ++f) {
+            for (int i = 0; i < 8; ++i) {
+                int idx = f * 8 + i;
+                prefs.putUInt((String("ch") + idx).c_str(), mixedFrame[idx]);
             }
-            notifyClients();
-            drawButtons();
         }
+        prefs.end();
+    } else if (doc.containsKey("artnetPassthrough")) {
+        artnetPassthrough = doc["artnetPassthrough"];
+        if (artnetPassthrough) artnetOutput = false;  // Never forward our own output back in
+    } else if (doc.containsKey("artnetHold")) {
+        int seconds = doc["artnetHold"];
+        if (seconds >= 0 && seconds <= ARTNET_HOLD_MAX) artnetHoldSeconds = seconds;
+    } else if (doc.containsKey("artnetOutput")) {
+        artnetOutput = doc["artnetOutput"];
+        if (artnetOutput) {
+            artnetPassthrough = false;
+            lastArtnetPoll = 0;  // Discover nodes right away
+        }
+    } else if (doc.containsKey("artnetOutUniverse")) {
+        int universe = doc["artnetOutUniverse"];
+        if (universe >= 0 && universe <= 0x7FFF && universe != artnetOutUniverse) {
+            artnetOutUniverse = universe;
+            // Subscriptions are per universe, so rediscover
+            for (int i = 0; i < ARTNET_MAX_NODES; ++i) artnetNodes[i].active = false;
+            lastArtnetPoll = 0;
+        }
+    } else if (doc.containsKey("sacnEnabled")) {
+        sacnEnabled = doc["sacnEnabled"];
+        sacnRestart = true;
+    } else if (doc.containsKey("sacnUniverse")) {
+        int universe = doc["sacnUniverse"];
+        if (universe >= 1 && universe <= 63999) {
+            sacnUniverse = universe;
+            sacnRestart = true;
+        }
+    } else if (doc.containsKey("dmxMode")) {
+        int mode = doc["dmxMode"];
+        if (mode >= DMX_MODE_FIXED && mode <= DMX_MODE_CHANGE) {
+            dmxMode = mode;
+            // Start a fresh latency measurement for the new mode
+            cmdLatencySum = 0;
+            cmdLatencyMax = 0;
+            cmdLatencyCount = 0;
+        }
+    } else if (doc.containsKey("dmxKeepAlive")) {
+        int hz = doc["dmxKeepAlive"];
+        if (hz >= 1 && hz <= 44) dmxKeepAliveHz = hz;
+    } else if (doc.containsKey("wifiConfig")) {
+        String newSsid = doc["wifiConfig"]["ssid"] | "";
+        String newPassword = doc["wifiConfig"]["password"] | "";
+        prefs.begin("dmx", false);
+        prefs.putString("wifiSsid", newSsid);
+        prefs.putString("wifiPassword", newPassword);
+        prefs.end();
+        ESP.restart();
     }
+    notifyPending = true;
+    drawButtons();
 }
 
 void notifyClients() {
-    StaticJsonDocument<200> doc;
-    doc["color"]["r"] = channelStates[CHANNEL_RED - 1].currentValue;
-    doc["color"]["g"] = channelStates[CHANNEL_GREEN - 1].currentValue;
-    doc["color"]["b"] = channelStates[CHANNEL_BLUE - 1].currentValue;
-    doc["white"] = channelStates[CHANNEL_WHITE - 1].currentValue;
-    doc["dimmer"] = channelStates[CHANNEL_DIMMER - 1].currentValue;
-    doc["strobe"] = channelStates[CHANNEL_STROBE - 1].currentValue;
-    doc["function"] = channelStates[CHANNEL_FUNCTION - 1].currentValue;
-    doc["speed"] = channelStates[CHANNEL_SPEED - 1].currentValue;
+    StaticJsonDocument<768> doc;
+    doc["color"]["r"] = mixedFrame[CHANNEL_RED - 1];
+    doc["color"]["g"] = mixedFrame[CHANNEL_GREEN - 1];
+    doc["color"]["b"] = mixedFrame[CHANNEL_BLUE - 1];
+    doc["white"] = mixedFrame[CHANNEL_WHITE - 1];
+    doc["dimmer"] = mixedFrame[CHANNEL_DIMMER - 1];
+    doc["strobe"] = mixedFrame[CHANNEL_STROBE - 1];
+    doc["function"] = mixedFrame[CHANNEL_FUNCTION - 1];
+    doc["speed"] = mixedFrame[CHANNEL_SPEED - 1];
     doc["scene"] = currentScene;
+    doc["sceneMaster"] = layers[LAYER_SCENE].opacity;
     doc["fixtureCount"] = fixtureCount;
     doc["artnetPassthrough"] = artnetPassthrough;
+    doc["artnetHold"] = artnetHoldSeconds;
+    doc["artnetOutput"] = artnetOutput;
+    doc["artnetOutUniverse"] = artnetOutUniverse;
+    doc["artnetNodes"] = countArtnetNodes();
+    doc["sacnEnabled"] = sacnEnabled;
+    doc["sacnUniverse"] = sacnUniverse;
+    doc["sacnSources"] = countSacnSources();
+    doc["dmxMode"] = dmxMode;
+    doc["dmxKeepAlive"] = dmxKeepAliveHz;
+    doc["dmxRate"] = lastDMXInterval > 0 ? 1000000UL / lastDMXInterval : 0;
+    doc["dmxLatency"] = lastDMXLatency;
+    doc["cmdLatencyCount"] = cmdLatencyCount;
+    doc["cmdLatencyAvg"] = cmdLatencyCount > 0 ? cmdLatencySum / cmdLatencyCount : 0;
+    doc["cmdLatencyMax"] = cmdLatencyMax;
+    if (mixBenchmarkMicros != 0) doc["mixBenchUs"] = mixBenchmarkMicros;
     
     String output;
     serializeJson(doc, output);
     ws.textAll(output);
 }
 
+// If-None-Match is "*" or a comma-separated list of tags, which proxies may
+// have weakened to W/"..." (gzip responses); the weak comparison ignores that
+bool etagMatches(const char* header, const char* etag) {
+    size_t etagLen = strlen(etag);
+    const char* p = header;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        if (*p == '*') return true;
+        if (p[0] == 'W' && p[1] == '/') p += 2;
+        const char* end = p;
+        while (*end && *end != ',') end++;
+        const char* last = end;
+        while (last > p && (last[-1] == ' ' || last[-1] == '\t')) last--;
+        if ((size_t)(last - p) == etagLen && strncmp(p, etag, etagLen) == 0) return true;
+        p = end;
+    }
+    return false;
+}
+
+void serveWebAsset(AsyncWebServerRequest *request, const WebAsset& asset) {
+    // Browser already has this exact version: answer without a body
+    if (request->hasHeader("If-None-Match") && etagMatches(request->getHeader("If-None-Match")->value().c_str(), asset.etag)) {
+        AsyncWebServerResponse *response = request->beginResponse(304);
+        response->addHeader("ETag", asset.etag);
+        response->addHeader("Cache-Control", asset.cacheControl);
+        response->addHeader("Vary", "Accept-Encoding");
+        request->send(response);
+        return;
+    }
+
+    AsyncWebServerResponse *response = request->beginResponse_P(200, asset.contentType, asset.data, asset.length);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("ETag", asset.etag);
+    response->addHeader("Cache-Control", asset.cacheControl);
+    response->addHeader("Vary", "Accept-Encoding");
+    request->send(response);
+}
+
 void setup() {
     auto cfg = M5.config();
     M5.begin(cfg);
@@ -302,23 +554,29 @@ void setup() {
     dmx_driver_install(dmxPort, &config, 0);
     dmx_set_pin(dmxPort, DMX_TX_PIN, DMX_RX_PIN, DMX_EN_PIN);
     
-    // Clear DMX buffer
+    // Clear DMX buffer and set up the mixer layers
+    initLayers();
     memset(dmxData, 0, DMX_PACKET_SIZE);
     dmx_write(dmxPort, dmxData, DMX_PACKET_SIZE);
     dmx_send(dmxPort, DMX_PACKET_SIZE);
     
-    // Initialize SPIFFS
-    if (!SPIFFS.begin(true)) {
-        M5.Display.println("SPIFFS failed!");
-        return;
-    }
-    
     prefs.begin("dmx", true);
 
     // Setup WiFi Access Point
     String savedSsid = prefs.getString("wifiSsid", "DMXController");
     String savedPassword = prefs.getString("wifiPassword", "dmx12345");
     artnetPassthrough = prefs.getUInt("artnet", 0) == 1;
+    artnetOutput = !artnetPassthrough && prefs.getUInt("artnetOut", 0) == 1;
+    artnetOutUniverse = prefs.getUInt("artnetUni", 0) & 0x7FFF;
+    artnetHoldSeconds = prefs.getUInt("artnetHold", 0);
+    if (artnetHoldSeconds > ARTNET_HOLD_MAX) artnetHoldSeconds = 0;
+    sacnEnabled = prefs.getUInt("sacn", 0) == 1;
+    sacnUniverse = prefs.getUInt("sacnUni", 1);
+    if (sacnUniverse < 1 || sacnUniverse > 63999) sacnUniverse = 1;
+    dmxMode = prefs.getUInt("dmxMode", DMX_MODE_CHANGE);
+    if (dmxMode > DMX_MODE_CHANGE) dmxMode = DMX_MODE_CHANGE;
+    dmxKeepAliveHz = prefs.getUInt("dmxKeep", DMX_KEEPALIVE_DEFAULT_HZ);
+    if (dmxKeepAliveHz < 1 || dmxKeepAliveHz > 44) dmxKeepAliveHz = DMX_KEEPALIVE_DEFAULT_HZ;
 
     WiFi.mode(WIFI_STA);
     WiFi.begin(savedSsid.c_str(), savedPassword.c_str());
@@ -354,8 +612,14 @@ void setup() {
         M5.Display.println(WiFi.softAPIP());
     }
     
-    // Setup web server
-    server.serveStatic("/", SPIFFS, "/").setDefaultFile("index.html");
+    // Setup web server (UI is compiled into the firmware, see tools/embed_web.py)
+    for (size_t i = 0; i < webAssetCount; ++i) {
+        const WebAsset* asset = &webAssets[i];
+        server.on(asset->path, HTTP_GET, [asset](AsyncWebServerRequest *request) { serveWebAsset(request, *asset); });
+        if (strcmp(asset->path, "/index.html") == 0) {
+            server.on("/", HTTP_GET, [asset](AsyncWebServerRequest *request) { serveWebAsset(request, *asset); });
+        }
+    }
 
     if (!artnetPassthrough) {
         dimmerValue = prefs.getUInt("dimmer", 0);
@@ -365,18 +629,20 @@ void setup() {
 
         resetAll();
 
+        // Saved channel values become the base look, a saved scene runs on top
+        Layer& base = layers[LAYER_BASE];
+        for (int f = 0; f < fixtureCount; ++f) {
+            for (int i = 0; i < 8; ++i) {
+                int idx = f * 8 + i;
+                base.values[idx] = prefs.getUInt((String("ch") + idx).c_str(), 0);
+                base.mask[idx] = 0xFF;
+            }
+        }
+        base.dirty = true;
+        mixLayers();
+
         if (savedScene != 0) {
             startScene(savedScene);
-        } else {
-            for (int f = 0; f < fixtureCount; ++f) {
-                for (int i = 0; i < 8; ++i) {
-                    int idx = f * 8 + i;
-                    int value = prefs.getUInt((String("ch") + idx).c_str(), 0);
-                    channelStates[idx].currentValue = value;
-                    channelStates[idx].targetValue = value;
-                    channelStates[idx].needsUpdate = false;
-                }
-            }
         }
 
         for (int f = 0; f < fixtureCount; ++f) setDimmer(dimmerValue, f);
@@ -385,13 +651,17 @@ void setup() {
     prefs.end();
 
     // Setup WebSocket
+    wsCommands = xQueueCreate(WS_COMMAND_QUEUE, sizeof(WsCommand));
     ws.onEvent(onWsEvent);
     server.addHandler(&ws);
     server.begin();
 
-    // Setup artnet passthrough
+    // Setup artnet passthrough / output
     artnetUDP.begin(ARTNET_PORT);
 
+    // Join the sACN multicast group on the first loop
+    sacnRestart = sacnEnabled;
+
     // draw buttons and notify clients
     drawButtons();
     notifyClients();
@@ -401,37 +671,52 @@ void loop() {
     M5.update();
 
     unsigned long currentMillis = millis();
-    static unsigned long lastNotify = 0;
-    if (currentMillis - lastNotify >= 1000) {
-        notifyClients();
-        lastNotify = currentMillis;
+
+    // Apply queued WebSocket commands before this iteration mixes
+    WsCommand command;
+    while (xQueueReceive(wsCommands, &command, 0) == pdTRUE) {
+        handleCommand(command);
+        // Layers are all clean here (mixed last iteration), so dirty means this command
+        if (!commandPending && layersDirty()) {
+            commandPending = true;
+            commandReceivedAt = command.receivedAt;
+        }
     }
 
+    Layer& network = layers[LAYER_ARTNET];
     if (artnetPassthrough) {
         int packetSize = artnetUDP.parsePacket();
         if (packetSize > 0) {
-            artnetUDP.read(artnetBuffer, sizeof(artnetBuffer));
+            int len = artnetUDP.read(artnetBuffer, sizeof(artnetBuffer));
             // Check Art-Net header
-            if (memcmp(artnetBuffer, "Art-Net\0", 8) == 0 && artnetBuffer[8] == 0x00 && artnetBuffer[9] == 0x50) {
-                // OpCode 0x5000 = ArtDMX
-                uint16_t dmxLen = artnetBuffer[17] << 8 | artnetBuffer[18];
+            if (len >= 18 && memcmp(artnetBuffer, "Art-Net\0", 8) == 0 && artnetBuffer[8] == 0x00 && artnetBuffer[9] == 0x50) {
+                // OpCode 0x5000 = ArtDMX, length is big-endian at offset 16
+                uint16_t dmxLen = artnetBuffer[16] << 8 | artnetBuffer[17];
                 if (dmxLen > 512) dmxLen = 512;
-                // Copy DMX data to output buffer (start at offset 18)
-                memset(dmxData, 0, sizeof(dmxData));
-                memcpy(dmxData + 1, artnetBuffer + 18, dmxLen); // DMX channel 1-based
-                int dmxPacketSize = dmxLen + 1;
-                dmx_write(dmxPort, dmxData, dmxPacketSize);
-                dmx_send(dmxPort, dmxPacketSize);
-                lastArtnetPacket = millis();
+                if (dmxLen > len - 18) dmxLen = len - 18;
+                // Copy DMX data (start at offset 18) into the network layer
+                memcpy(network.values, artnetBuffer + 18, dmxLen);
+                memset(network.mask, 0xFF, dmxLen);
+                memset(network.mask + dmxLen, 0, MAX_DMX_CHANNELS - dmxLen);
+                network.length = dmxLen;
+                network.active = true;
+                network.dirty = true;
+                lastArtnetPacket = currentMillis;
             }
         }
-        delay(5);
-        return; // Skip rest of loop if in Art-Net mode
+    }
+    bool artnetReleased = artnetHoldSeconds > 0 && currentMillis - lastArtnetPacket > artnetHoldSeconds * 1000UL;
+    if (network.active && (!artnetPassthrough || artnetReleased)) {
+        clearLayer(LAYER_ARTNET);
     }
 
-    // Handle touch input
+    if (sacnEnabled || sacnRestart) {
+        updateSacn(currentMillis);
+    }
+
+    // Handle touch input (the LCD shows the Art-Net status screen in passthrough)
     auto t = M5.Touch.getDetail();
-    if (t.wasPressed() || t.isPressed()) {
+    if (!artnetPassthrough && (t.wasPressed() || t.isPressed())) {
         // Check buttons
         for (const auto& button : buttons) {
             if (t.x >= button.x && t.x <= button.x + BUTTON_WIDTH &&
@@ -508,35 +793,85 @@ void loop() {
         }
     }
 
-    // Update transitions
-    updateTransition();
+    // Update transitions (on a fixed tick, so their speed does not depend on the loop rate)
+    static unsigned long lastTransitionTick = 0;
+    if (currentMillis - lastTransitionTick >= TRANSITION_TICK) {
+        updateTransition();
+        lastTransitionTick = currentMillis;
+    }
 
-    // 40Hz DMX update loop (25ms interval)
-    static unsigned long lastDMXUpdate = 0;
-    int currentDMXInterval = currentMillis - lastDMXUpdate;
-    if (currentDMXInterval >= 25) {
-        // Wait for previous DMX packet to be sent
-        dmx_wait_sent(dmxPort, DMX_TIMEOUT_TICK);
-        
-        // Update DMX values from channel states (multi-fixture)
-        memset(dmxData, 0, sizeof(dmxData));
-        for (int f = 0; f < fixtureCount; ++f) {
-            for (int i = 0; i < 8; ++i) {
-                int idx = f * 8 + i;
-                dmxData[idx + 1] = channelStates[idx].currentValue;
-            }
-        }
+    // Combine the layer stack (no-op when no layer changed)
+    if (mixLayers() && !dmxFrameReady) {
+        dmxFrameReady = true;
+        dmxFrameReadyAt = micros();
+    }
+
+    if (mixBenchmarkPending) {
+        mixBenchmarkPending = false;
+        mixBenchmarkMicros = benchmarkMixer();
+        Serial.println("Mixer benchmark, 6 layers x 512 channels: " + String(mixBenchmarkMicros) + " us");
+        notifyPending = true;
+    }
+
+    // Art-Net output node mode (paced independently of the DMX port)
+    if (artnetOutput) {
+        updateArtnetOutput(currentMillis);
+    }
+
+    // DMX output, see dmxFrameDue() for the scheduling
+    int channels = mixedChannelCount();
+    int dmxPacketSize = channels + 1;
+    unsigned long nowMicros = micros();
+    // Only send once the previous packet has left the wire (never blocks)
+    if (dmxFrameDue(dmxPacketSize, nowMicros) && dmx_wait_sent(dmxPort, 0)) {
+        // Update DMX values from the mixed frame
+        memcpy(dmxData + 1, mixedFrame, channels);
         
         // Write/send only the used part of the buffer
-        int dmxPacketSize = fixtureCount * 8 + 1;
         dmx_write(dmxPort, dmxData, dmxPacketSize);
         dmx_send(dmxPort, dmxPacketSize);
         
-        lastDMXInterval = currentDMXInterval;
-        lastDMXUpdate = currentMillis;
+        if (dmxFrameReady) {
+            // Until the last slot is out: waiting for the wire plus the frame itself
+            lastDMXLatency = nowMicros - dmxFrameReadyAt + dmxFrameMicros(dmxPacketSize);
+            dmxFrameReady = false;
+        }
+        if (commandPending) {
+            unsigned long latency = nowMicros - commandReceivedAt + dmxFrameMicros(dmxPacketSize);
+            cmdLatencySum += latency;
+            if (latency > cmdLatencyMax) cmdLatencyMax = latency;
+            cmdLatencyCount++;
+            commandPending = false;
+        }
+        lastDMXInterval = nowMicros - lastDMXSend;
+        lastDMXSend = nowMicros;
     }
-    
-    delay(5);
+
+    // Status reflects the freshly mixed frame and the latest DMX timing, on
+    // change and once per second
+    static unsigned long lastNotify = 0;
+    if (notifyPending || currentMillis - lastNotify >= 1000) {
+        notifyPending = false;
+        notifyClients();
+        lastNotify = currentMillis;
+    }
+
+    delay(dmxMode == DMX_MODE_FIXED ? 5 : 1);
+}
+
+// Time one frame of packetSize slots (start code included) occupies the wire
+unsigned long dmxFrameMicros(int packetSize) {
+    unsigned long frame = dmx_get_break_len(dmxPort) + dmx_get_mab_len(dmxPort) +
+                          packetSize * DMX_SLOT_MICROS + DMX_FRAME_MARGIN_MICROS;
+    return frame < DMX_MIN_FRAME_MICROS ? DMX_MIN_FRAME_MICROS : frame;
+}
+
+bool dmxFrameDue(int packetSize, unsigned long nowMicros) {
+    unsigned long sinceLast = nowMicros - lastDMXSend;
+    if (dmxMode == DMX_MODE_FIXED) return sinceLast >= DMX_FIXED_INTERVAL_MICROS;
+    if (sinceLast < dmxFrameMicros(packetSize)) return false;  // Fastest rate for this packet length
+    if (dmxMode == DMX_MODE_CONTINUOUS || dmxFrameReady) return true;
+    return sinceLast >= 1000000UL / dmxKeepAliveHz;            // Idle keep-alive
 }
 
 void drawSliders() {
@@ -633,13 +968,21 @@ void drawButtons() {
     String ipStr = (WiFi.getMode() == WIFI_STA && WiFi.status() == WL_CONNECTED) ? WiFi.localIP().toString() : WiFi.softAPIP().toString();
     M5.Display.setCursor(labelX, labelY);
     M5.Display.printf("SSID: %s | IP: %s | Fixtures: %d", ssidStr.c_str(), ipStr.c_str(), fixtureCount);
+    if (artnetOutput) {
+        M5.Display.setCursor(labelX, labelY + 12);
+        M5.Display.printf("Art-Net out: universe %d | Nodes: %d", artnetOutUniverse, countArtnetNodes());
+    }
+    if (sacnEnabled) {
+        M5.Display.setCursor(labelX, labelY + 24);
+        M5.Display.printf("sACN: universe %d | Sources: %d", sacnUniverse, countSacnSources());
+    }
 
     // Draw sliders
     drawSliders();
 }
 
 void updateScene() {
-    if (isRunningScene && !manualOverride) {
+    if (isRunningScene) {
         switch (currentScene) {
             case 1: // Rainbow
                 for (int f = 0; f < fixtureCount; ++f) {
@@ -702,9 +1045,11 @@ void updateTransition() {
                 : 1 - pow(-2 * progress + 2, 2) / 2;
             for (int i = 0; i < 8; i++) {
                 if (channelStates[f * 8 + i].needsUpdate) {
-                    uint8_t before = channelStates[f * 8 + i].currentValue;
                     channelStates[f * 8 + i].currentValue = channelStates[f * 8 + i].currentValue + 
                         (channelStates[f * 8 + i].targetValue - channelStates[f * 8 + i].currentValue) * progress;
+                    layers[LAYER_SCENE].values[f * 8 + i] = channelStates[f * 8 + i].currentValue;
+                    layers[LAYER_SCENE].mask[f * 8 + i] = 0xFF;
+                    layers[LAYER_SCENE].dirty = true;
                 }
             }
             transitionStep[f]++;
@@ -714,6 +1059,9 @@ void updateTransition() {
                 if (channelStates[f * 8 + i].needsUpdate) {
                     channelStates[f * 8 + i].currentValue = channelStates[f * 8 + i].targetValue;
                     channelStates[f * 8 + i].needsUpdate = false;
+                    layers[LAYER_SCENE].values[f * 8 + i] = channelStates[f * 8 + i].currentValue;
+                    layers[LAYER_SCENE].mask[f * 8 + i] = 0xFF;
+                    layers[LAYER_SCENE].dirty = true;
                 }
             }
         }
@@ -742,7 +1090,15 @@ void startScene(int scene) {
     isRunningScene = true;
     sceneHue = 0.0;
     chasePosition = 0;
-    manualOverride = false; // Reset manual override when starting a scene
+    // Scenes drive the colour channels: release them from the manual programmer
+    // and start the transition from what is currently on the output
+    for (int f = 0; f < fixtureCount; ++f) {
+        for (int channel = CHANNEL_RED; channel <= CHANNEL_BLUE; ++channel) {
+            int idx = f * 8 + channel - 1;
+            channelStates[idx].currentValue = mixedFrame[idx];
+            releaseManual(idx);
+        }
+    }
     startTransition(0);  // Only start transition when starting a scene
 }
 
@@ -750,16 +1106,23 @@ void stopScene() {
     currentScene = 0;
     isRunningScene = false;
     startTransition(0);
-    notifyClients();
+    notifyPending = true;
     drawButtons();
 }
 
 void setChannelValue(int channel, uint8_t value, int fixture) {
     if (channel >= 1 && channel <= 8 && fixture >= 0 && fixture < MAX_FIXTURES) {
         int idx = fixture * 8 + (channel - 1);
-        channelStates[idx].targetValue = value;
-        channelStates[idx].currentValue = value;
-        channelStates[idx].needsUpdate = false;
+        layers[LAYER_MANUAL].values[idx] = value;
+        layers[LAYER_MANUAL].mask[idx] = 0xFF;
+        layers[LAYER_MANUAL].dirty = true;
+    }
+}
+
+void releaseManual(int idx) {
+    if (layers[LAYER_MANUAL].mask[idx]) {
+        layers[LAYER_MANUAL].mask[idx] = 0;
+        layers[LAYER_MANUAL].dirty = true;
     }
 }
 
@@ -770,6 +1133,471 @@ void setColor(uint8_t r, uint8_t g, uint8_t b, int fixture) {
 }
 
 void setDimmer(uint8_t value, int fixture) { setChannelValue(CHANNEL_DIMMER, value, fixture); }
-void setRedManual() { for (int f = 0; f < fixtureCount; ++f) setColor(255, 0, 0, f); manualOverride = true; drawButtons(); notifyClients(); }
-void setGreenManual() { for (int f = 0; f < fixtureCount; ++f) setColor(0, 255, 0, f); manualOverride = true; drawButtons(); notifyClients(); }
-void setBlueManual() { for (int f = 0; f < fixtureCount; ++f) setColor(0, 0, 255, f); manualOverride = true; drawButtons(); notifyClients(); } 
\ No newline at end of file
+void setRedManual() { for (int f = 0; f < fixtureCount; ++f) setColor(255, 0, 0, f); drawButtons(); notifyPending = true; }
+void setGreenManual() { for (int f = 0; f < fixtureCount; ++f) setColor(0, 255, 0, f); drawButtons(); notifyPending = true; }
+void setBlueManual() { for (int f = 0; f < fixtureCount; ++f) setColor(0, 0, 255, f); drawButtons(); notifyPending = true; }
+
+void initLayers() {
+    const uint8_t priorities[LAYER_COUNT] = {0, 10, 20, 30, 40};
+    for (int i = 0; i < LAYER_COUNT; ++i) {
+        clearLayer(i);
+        layers[i].mode = LAYER_LTP;
+        layers[i].opacity = 255;
+        layers[i].priority = priorities[i];
+        layers[i].active = i != LAYER_ARTNET && i != LAYER_SACN;  // Network input activates on its first packet
+    }
+    layerOrderDirty = true;
+}
+
+void clearLayer(int layer) {
+    memset(layers[layer].values, 0, MAX_DMX_CHANNELS);
+    memset(layers[layer].mask, 0, MAX_DMX_CHANNELS);
+    layers[layer].length = 0;
+    if (layer == LAYER_ARTNET || layer == LAYER_SACN) layers[layer].active = false;
+    layers[layer].dirty = true;
+}
+
+// Combine the layer stack into mixedFrame. Returns true if the frame was recombined.
+bool mixLayers() {
+    if (layerOrderDirty) {
+        // Insertion sort by priority; the stack is tiny and rarely reordered
+        for (int i = 0; i < LAYER_COUNT; ++i) layerOrder[i] = i;
+        for (int i = 1; i < LAYER_COUNT; ++i) {
+            uint8_t id = layerOrder[i];
+            int j = i - 1;
+            while (j >= 0 && layers[layerOrder[j]].priority > layers[id].priority) {
+                layerOrder[j + 1] = layerOrder[j];
+                j--;
+            }
+            layerOrder[j + 1] = id;
+        }
+        layers[layerOrder[0]].dirty = true;
+        layerOrderDirty = false;
+    }
+
+    // Everything below the lowest dirty layer is still valid in layerComposite
+    int start = 0;
+    while (start < LAYER_COUNT && !layers[layerOrder[start]].dirty) start++;
+    if (start == LAYER_COUNT) return false;
+
+    static const uint8_t blackFrame[MAX_DMX_CHANNELS] = {0};
+    for (int pos = start; pos < LAYER_COUNT; ++pos) {
+        Layer& layer = layers[layerOrder[pos]];
+        layer.dirty = false;  // Before combining, so a change made meanwhile is not lost
+        combineLayer(layer, pos > 0 ? layerComposite[pos - 1] : blackFrame, layerComposite[pos]);
+    }
+    return true;
+}
+
+// True if the next mixLayers() will recombine something
+bool layersDirty() {
+    if (layerOrderDirty) return true;
+    for (int i = 0; i < LAYER_COUNT; ++i) {
+        if (layers[i].dirty) return true;
+    }
+    return false;
+}
+
+// Time a full recombine of 6 active full-universe layers (alternating LTP
+// and HTP), the worst case for mixLayers(). Result in microseconds.
+float benchmarkMixer() {
+    const int count = 6;
+    const int rounds = 200;
+    Layer* bench = (Layer*)malloc(sizeof(Layer) * count);
+    uint8_t* frames = (uint8_t*)malloc(MAX_DMX_CHANNELS * (count + 1));
+    if (!bench || !frames) {
+        free(bench);
+        free(frames);
+        return -1;
+    }
+
+    uint32_t seed = 12345;
+    for (int l = 0; l < count; ++l) {
+        for (int c = 0; c < MAX_DMX_CHANNELS; ++c) {
+            seed = seed * 1103515245 + 12345;
+            bench[l].values[c] = seed >> 24;
+            bench[l].mask[c] = 0xFF;
+        }
+        bench[l].mode = l % 2 ? LAYER_HTP : LAYER_LTP;
+        bench[l].opacity = 200;
+        bench[l].active = true;
+    }
+    memset(frames, 0, MAX_DMX_CHANNELS);
+
+    unsigned long start = micros();
+    for (int r = 0; r < rounds; ++r) {
+        for (int l = 0; l < count; ++l) {
+            combineLayer(bench[l], frames + l * MAX_DMX_CHANNELS, frames + (l + 1) * MAX_DMX_CHANNELS);
+        }
+    }
+    float perMix = (float)(micros() - start) / rounds;
+
+    free(bench);
+    free(frames);
+    return perMix;
+}
+
+// Number of channels to put on the wire: the patched fixtures, or more if a
+// (network) layer carries a longer universe
+int mixedChannelCount() {
+    int channels = fixtureCount * 8;
+    for (int i = 0; i < LAYER_COUNT; ++i) {
+        if (layers[i].active && layers[i].length > channels) channels = layers[i].length;
+    }
+    return channels > MAX_DMX_CHANNELS ? MAX_DMX_CHANNELS : channels;
+}
+
+IPAddress sacnMulticastIP(uint16_t universe) {
+    return IPAddress(239, 255, universe >> 8, universe & 0xFF);
+}
+
+uint16_t readUint16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+uint32_t readUint32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3]; }
+
+int countSacnSources() {
+    int count = 0;
+    for (int i = 0; i < SACN_MAX_SOURCES; ++i) {
+        if (sacnSources[i].active) count++;
+    }
+    return count;
+}
+
+void joinSacnSyncUniverse(uint16_t address) {
+    if (address == sacnSyncUniverse) return;
+    sacnSyncUDP.stop();
+    sacnSyncUniverse = address;
+    lastSacnSync = 0;
+    // Sync packets on our own data universe already arrive on sacnUDP
+    if (address != 0 && address != sacnUniverse) {
+        sacnSyncUDP.beginMulticast(sacnMulticastIP(address), SACN_PORT);
+    }
+}
+
+// Follow the sync address of the winning (highest priority) sources. The
+// joined universe is kept while any of them still uses it, so competing
+// sources cannot cause an IGMP leave/join per packet, and it is left once
+// none of them does.
+void updateSacnSyncUniverse() {
+    int winner = -1;
+    for (int i = 0; i < SACN_MAX_SOURCES; ++i) {
+        if (sacnSources[i].active && (winner < 0 || sacnSources[i].priority > sacnSources[winner].priority)) winner = i;
+    }
+    if (winner < 0) {
+        joinSacnSyncUniverse(0);
+        return;
+    }
+    for (int i = 0; i < SACN_MAX_SOURCES; ++i) {
+        const SacnSource& source = sacnSources[i];
+        if (source.active && source.priority == sacnSources[winner].priority &&
+            sacnSyncUniverse != 0 && source.syncAddress == sacnSyncUniverse) return;
+    }
+    joinSacnSyncUniverse(sacnSources[winner].syncAddress);
+}
+
+// Merge all live sources into the sACN layer: only the highest priority
+// counts, sources sharing that priority are combined HTP
+void mergeSacnSources() {
+    Layer& layer = layers[LAYER_SACN];
+    int topPriority = -1;
+    for (int i = 0; i < SACN_MAX_SOURCES; ++i) {
+        if (sacnSources[i].active && sacnSources[i].priority > topPriority) topPriority = sacnSources[i].priority;
+    }
+
+    memset(layer.values, 0, MAX_DMX_CHANNELS);
+    uint16_t length = 0;
+    for (int i = 0; i < SACN_MAX_SOURCES; ++i) {
+        const SacnSource& source = sacnSources[i];
+        if (!source.active || source.priority != topPriority) continue;
+        for (int c = 0; c < source.length; ++c) {
+            if (source.values[c] > layer.values[c]) layer.values[c] = source.values[c];
+        }
+        if (source.length > length) length = source.length;
+    }
+
+    memset(layer.mask, 0xFF, length);
+    memset(layer.mask + length, 0, MAX_DMX_CHANNELS - length);
+    layer.length = length;
+    layer.active = topPriority >= 0;
+    layer.dirty = true;
+}
+
+void handleSacnData(const uint8_t* packet, int len, unsigned long now) {
+    // Framing layer: vector, universe and options, DMP layer: start code 0x00 only
+    if (len < 126 || readUint32(packet + 40) != 0x00000002) return;
+    if (readUint16(packet + 113) != sacnUniverse) return;
+    if (packet[117] != 0x02 || packet[118] != 0xA1 || packet[125] != 0x00) return;
+    uint8_t options = packet[112];
+    if (options & 0x80) return;  // Preview data, not meant for live output
+
+    const uint8_t* cid = packet + 22;
+    int slot = -1;
+    int freeSlot = -1;
+    for (int i = 0; i < SACN_MAX_SOURCES; ++i) {
+        if (sacnSources[i].active && memcmp(sacnSources[i].cid, cid, 16) == 0) {
+            slot = i;
+            break;
+        }
+        if (!sacnSources[i].active && freeSlot < 0) freeSlot = i;
+    }
+
+    uint8_t sequence = packet[111];
+    if (slot >= 0) {
+        // E1.31 6.7.2: drop packets that are late or duplicated
+        int8_t diff = (int8_t)(sequence - sacnSources[slot].sequence);
+        if (diff <= 0 && diff > -20) return;
+    }
+
+    if (options & 0x40) {
+        // Stream terminated: forget the source right away
+        if (slot >= 0) {
+            sacnSources[slot].active = false;
+            updateSacnSyncUniverse();
+            mergeSacnSources();
+        }
+        return;
+    }
+
+    if (slot < 0) {
+        if (freeSlot < 0) return;  // Out of source slots
+        slot = freeSlot;
+        memcpy(sacnSources[slot].cid, cid, 16);
+        sacnSources[slot].length = 0;  // Nothing released yet
+        sacnSources[slot].pending = false;
+        sacnSources[slot].active = true;
+    }
+
+    SacnSource& source = sacnSources[slot];
+    source.priority = packet[108] > 200 ? 200 : packet[108];
+    source.sequence = sequence;
+    source.syncAddress = readUint16(packet + 109);
+    source.lastSeen = now;
+    updateSacnSyncUniverse();
+
+    uint16_t count = readUint16(packet + 123);  // Property value count includes the start code
+    count = count > 0 ? count - 1 : 0;
+    if (count > MAX_DMX_CHANNELS) count = MAX_DMX_CHANNELS;
+    if (count > len - 126) count = len - 126;
+
+    // Hold synchronized data for its sync packet, unless we do not receive
+    // that sync universe or its stream has gone quiet, in which case we fall
+    // back to unsynchronized output
+    if (source.syncAddress != 0 && source.syncAddress == sacnSyncUniverse &&
+        lastSacnSync != 0 && now - lastSacnSync <= SACN_SOURCE_TIMEOUT) {
+        memcpy(source.held, packet + 126, count);
+        source.heldLength = count;
+        source.pending = true;
+        return;
+    }
+    memcpy(source.values, packet + 126, count);
+    source.length = count;
+    source.pending = false;  // Unsynchronized data replaces anything still held
+    mergeSacnSources();
+}
+
+void handleSacnSync(const uint8_t* packet, int len, unsigned long now) {
+    if (len < 49 || readUint32(packet + 40) != 0x00000001) return;
+    uint16_t address = readUint16(packet + 45);
+
+    bool release = false;
+    for (int i = 0; i < SACN_MAX_SOURCES; ++i) {
+        SacnSource& source = sacnSources[i];
+        if (source.active && source.pending && source.syncAddress == address) {
+            memcpy(source.values, source.held, source.heldLength);
+            source.length = source.heldLength;
+            source.pending = false;
+            release = true;
+        }
+    }
+    if (address == sacnSyncUniverse) lastSacnSync = now;
+    if (release) mergeSacnSources();
+}
+
+// Parse an E1.31 packet in place in sacnBuffer
+void handleSacnPacket(int len, unsigned long now) {
+    const uint8_t* packet = sacnBuffer;
+    if (len < 49) return;
+    if (readUint16(packet) != 0x0010 || readUint16(packet + 2) != 0x0000) return;
+    if (memcmp(packet + 4, "ASC-E1.17\0\0\0", 12) != 0) return;
+
+    uint32_t rootVector = readUint32(packet + 18);
+    if (rootVector == 0x00000004) {         // VECTOR_ROOT_E131_DATA
+        handleSacnData(packet, len, now);
+    } else if (rootVector == 0x00000008) {  // VECTOR_ROOT_E131_EXTENDED
+        handleSacnSync(packet, len, now);
+    }
+}
+
+void updateSacn(unsigned long now) {
+    if (sacnRestart) {
+        sacnRestart = false;
+        sacnUDP.stop();
+        joinSacnSyncUniverse(0);
+        for (int i = 0; i < SACN_MAX_SOURCES; ++i) sacnSources[i].active = false;
+        mergeSacnSources();
+        // With modem sleep the access point buffers multicast until the next
+        // DTIM beacon, which adds 100 ms or more to every sACN frame
+        WiFi.setSleep(!sacnEnabled);
+        if (!sacnEnabled) return;
+        sacnUDP.beginMulticast(sacnMulticastIP(sacnUniverse), SACN_PORT);
+        Serial.println("sACN listening on universe " + String(sacnUniverse));
+    }
+
+    // Drain both sockets (bounded, so a busy network cannot stall the loop)
+    for (int i = 0; i < 8; ++i) {
+        if (sacnUDP.parsePacket() <= 0) break;
+        handleSacnPacket(sacnUDP.read(sacnBuffer, sizeof(sacnBuffer)), now);
+    }
+    if (sacnSyncUniverse != 0 && sacnSyncUniverse != sacnUniverse) {
+        for (int i = 0; i < 4; ++i) {
+            if (sacnSyncUDP.parsePacket() <= 0) break;
+            handleSacnPacket(sacnSyncUDP.read(sacnBuffer, sizeof(sacnBuffer)), now);
+        }
+    }
+
+    // Sources that stopped sending without a stream terminated packet
+    bool changed = false;
+    for (int i = 0; i < SACN_MAX_SOURCES; ++i) {
+        if (sacnSources[i].active && now - sacnSources[i].lastSeen > SACN_SOURCE_TIMEOUT) {
+            sacnSources[i].active = false;
+            changed = true;
+        }
+    }
+    if (changed) {
+        updateSacnSyncUniverse();
+        mergeSacnSources();
+    }
+}
+
+IPAddress artnetBroadcastIP() {
+    if (WiFi.getMode() == WIFI_STA && WiFi.status() == WL_CONNECTED) return WiFi.broadcastIP();
+    return WiFi.softAPBroadcastIP();
+}
+
+void writeArtnetHeader(uint16_t opCode) {
+    memcpy(artnetTxBuffer, "Art-Net\0", 8);
+    artnetTxBuffer[8] = opCode & 0xFF;  // OpCode is little-endian
+    artnetTxBuffer[9] = opCode >> 8;
+    artnetTxBuffer[10] = 0;             // Protocol version 14, big-endian
+    artnetTxBuffer[11] = 14;
+}
+
+void sendArtnetPacket(IPAddress ip, size_t len) {
+    artnetUDP.beginPacket(ip, ARTNET_PORT);
+    artnetUDP.write(artnetTxBuffer, len);
+    artnetUDP.endPacket();
+}
+
+int countArtnetNodes() {
+    int count = 0;
+    for (int i = 0; i < ARTNET_MAX_NODES; ++i) {
+        if (artnetNodes[i].active) count++;
+    }
+    return count;
+}
+
+void handleArtPollReply(const uint8_t* packet, int len, unsigned long now) {
+    if (len < 194) return;  // Too short to carry the SwOut fields
+
+    // Only nodes with an output port patched to our universe subscribe
+    uint16_t netSub = ((packet[18] & 0x7F) << 8) | ((packet[19] & 0x0F) << 4);
+    int numPorts = packet[173] > 4 ? 4 : packet[173];
+    bool subscribed = false;
+    for (int p = 0; p < numPorts; ++p) {
+        bool canOutput = packet[174 + p] & 0x80;
+        if (canOutput && (netSub | (packet[190 + p] & 0x0F)) == artnetOutUniverse) {
+            subscribed = true;
+            break;
+        }
+    }
+    if (!subscribed) return;
+
+    IPAddress ip(packet[10], packet[11], packet[12], packet[13]);
+    int freeSlot = -1;
+    for (int i = 0; i < ARTNET_MAX_NODES; ++i) {
+        if (artnetNodes[i].active && artnetNodes[i].ip == ip) {
+            artnetNodes[i].lastSeen = now;
+            return;
+        }
+        if (!artnetNodes[i].active && freeSlot < 0) freeSlot = i;
+    }
+    if (freeSlot >= 0) {
+        artnetNodes[freeSlot].ip = ip;
+        artnetNodes[freeSlot].lastSeen = now;
+        artnetNodes[freeSlot].active = true;
+        Serial.println("Art-Net node found: " + ip.toString());
+    }
+}
+
+void sendArtPoll() {
+    writeArtnetHeader(0x2000);
+    artnetTxBuffer[12] = 0x02;  // Flags: send ArtPollReply whenever node conditions change
+    artnetTxBuffer[13] = 0x00;  // DiagPriority (no diagnostics)
+    sendArtnetPacket(artnetBroadcastIP(), 14);
+}
+
+void updateArtnetOutput(unsigned long now) {
+    // Collect ArtPollReplies (bounded, so a busy network cannot stall the loop)
+    for (int i = 0; i < 4; ++i) {
+        int packetSize = artnetUDP.parsePacket();
+        if (packetSize <= 0) break;
+        int len = artnetUDP.read(artnetBuffer, sizeof(artnetBuffer));
+        if (len >= 10 && memcmp(artnetBuffer, "Art-Net\0", 8) == 0 && artnetBuffer[8] == 0x00 && artnetBuffer[9] == 0x21) {
+            // OpCode 0x2100 = ArtPollReply
+            handleArtPollReply(artnetBuffer, len, now);
+        }
+    }
+
+    if (lastArtnetPoll == 0 || now - lastArtnetPoll >= ARTNET_POLL_INTERVAL) {
+        for (int i = 0; i < ARTNET_MAX_NODES; ++i) {
+            if (artnetNodes[i].active && now - artnetNodes[i].lastSeen > ARTNET_NODE_TIMEOUT) {
+                artnetNodes[i].active = false;
+                Serial.println("Art-Net node lost: " + artnetNodes[i].ip.toString());
+            }
+        }
+        sendArtPoll();
+        lastArtnetPoll = now;
+    }
+
+    if (now - lastArtnetOutput < ARTNET_OUTPUT_INTERVAL) return;
+
+    // ArtDmx length must be even and between 2 and 512
+    uint16_t length = mixedChannelCount();
+    if (length > DMX_PACKET_SIZE) length = DMX_PACKET_SIZE;
+    if (length & 1) length++;
+    if (length < 2) length = 2;
+
+    // Only send changed frames, plus a keep-alive so nodes do not time out
+    bool changed = length != artnetLastSentLength || memcmp(artnetLastSent, mixedFrame, length) != 0;
+    if (!changed && now - lastArtnetOutput < ARTNET_KEEPALIVE_INTERVAL) return;
+
+    artnetSequence = artnetSequence == 255 ? 1 : artnetSequence + 1;  // 0 disables sequencing
+    writeArtnetHeader(0x5000);
+    artnetTxBuffer[12] = artnetSequence;
+    artnetTxBuffer[13] = 0;                                // Physical port
+    artnetTxBuffer[14] = artnetOutUniverse & 0xFF;         // SubUni
+    artnetTxBuffer[15] = (artnetOutUniverse >> 8) & 0x7F;  // Net
+    artnetTxBuffer[16] = length >> 8;
+    artnetTxBuffer[17] = length & 0xFF;
+    memcpy(artnetTxBuffer + 18, mixedFrame, length);
+
+    // Batch the whole frame: unicast to every subscriber, or one broadcast
+    // if there are none (or too many to unicast without flooding the air)
+    int nodeCount = countArtnetNodes();
+    if (nodeCount == 0 || nodeCount > ARTNET_MAX_UNICAST) {
+        sendArtnetPacket(artnetBroadcastIP(), 18 + length);
+    } else {
+        for (int i = 0; i < ARTNET_MAX_NODES; ++i) {
+            if (artnetNodes[i].active) sendArtnetPacket(artnetNodes[i].ip, 18 + length);
+        }
+    }
+
+    // ArtSync makes all nodes output the frame at the same time
+    writeArtnetHeader(0x5200);
+    artnetTxBuffer[12] = 0;  // Aux1
+    artnetTxBuffer[13] = 0;  // Aux2
+    sendArtnetPacket(artnetBroadcastIP(), 14);
+
+    memcpy(artnetLastSent, mixedFrame, length);
+    artnetLastSentLength = length;
+    lastArtnetOutput = now;
+}
@@ -0,0 +1,157 @@
+# Loopback receiver for the Art-Net output mode.
+#
+# Pretends to be one or more Art-Net nodes: every ArtPoll is answered with an
+# ArtPollReply per --node address, patched to --universe, so the device
+# unicasts its frames to them. Once per second it reports:
+#   - ArtDmx packets/s, frames/s and ArtSync/s
+#   - inter-node skew: spread between the first and last node receiving the
+#     same frame (what ArtSync hides from the fixtures)
+#   - ArtDmx-to-ArtSync delay: first ArtDmx of a frame until its ArtSync
+#   - lost frames, from gaps in the sequence numbers
+#
+# Every --node address must be configured on this host (on Linux any 127.x.x.x
+# address works for a local test). Frames the device broadcasts are counted
+# under "broadcast". Usage:
+#   python tools/artnet_loopback.py --node 192.168.1.50 --node 192.168.1.51 --universe 0
+
+import argparse
+import socket
+import struct
+import time
+
+ARTNET_PORT = 6454
+ARTNET_ID = b"Art-Net\x00"
+OP_POLL = 0x2000
+OP_POLL_REPLY = 0x2100
+OP_DMX = 0x5000
+OP_SYNC = 0x5200
+
+IP_PKTINFO = getattr(socket, "IP_PKTINFO", 8)  # Linux value, missing on older Pythons
+
+
+def poll_reply(node_ip, universe, index):
+    reply = bytearray(239)
+    reply[0:8] = ARTNET_ID
+    struct.pack_into("<H", reply, 8, OP_POLL_REPLY)
+    reply[10:14] = socket.inet_aton(node_ip)
+    struct.pack_into("<H", reply, 14, ARTNET_PORT)
+    reply[18] = (universe >> 8) & 0x7F             # NetSwitch
+    reply[19] = (universe >> 4) & 0x0F             # SubSwitch
+    name = ("loopback-%d" % index).encode()
+    reply[26:26 + len(name)] = name                # ShortName
+    reply[44:44 + len(name)] = name                # LongName
+    reply[173] = 1                                 # NumPorts
+    reply[174] = 0x80                              # Port 1 outputs DMX512
+    reply[182] = 0x80                              # GoodOutput: data being transmitted
+    reply[190] = universe & 0x0F                   # SwOut
+    reply[207:211] = socket.inet_aton(node_ip)     # BindIp
+    reply[211] = index + 1                         # BindIndex
+    return bytes(reply)
+
+
+class Stats:
+    def __init__(self):
+        self.reset()
+        self.last_seq = {}   # node -> last ArtDmx sequence
+        self.frames = {}     # sequence -> {node: arrival}
+        self.latest_seq = None
+
+    def reset(self):
+        self.dmx = 0
+        self.syncs = 0
+        self.polls = 0
+        self.lost = 0
+        self.new_frames = 0
+        self.skews = []
+        self.sync_delays = []
+
+    def on_dmx(self, node, seq, now):
+        self.dmx += 1
+        if seq != 0 and node in self.last_seq:
+            # Sequence runs 1..255 and skips 0
+            gap = (seq - self.last_seq[node] - 1) % 255
+            if gap < 128:
+                self.lost += gap
+        self.last_seq[node] = seq
+
+        arrivals = self.frames.setdefault(seq, {})
+        if not arrivals:
+            self.new_frames += 1
+        arrivals[node] = now
+        self.latest_seq = seq
+        if len(self.frames) > 16:
+            self.frames.pop(next(iter(self.frames)))
+
+    def on_sync(self, now, node_count):
+        self.syncs += 1
+        arrivals = self.frames.get(self.latest_seq)
+        if not arrivals:
+            return
+        self.sync_delays.append(now - min(arrivals.values()))
+        if node_count > 1 and len(arrivals) == node_count:
+            self.skews.append(max(arrivals.values()) - min(arrivals.values()))
+
+    def report(self, elapsed):
+        def ms(values):
+            if not values:
+                return "-"
+            return "avg %.2f / max %.2f ms" % (1000 * sum(values) / len(values), 1000 * max(values))
+        print("dmx %6.1f pkt/s | frames %5.1f/s | sync %5.1f/s | lost %d | skew %s | dmx->sync %s" % (
+            self.dmx / elapsed, self.new_frames / elapsed, self.syncs / elapsed, self.lost,
+            ms(self.skews), ms(self.sync_delays)), flush=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Emulate Art-Net nodes and measure the device's output")
+    parser.add_argument("--node", action="append", required=True, help="node address on this host (repeatable)")
+    parser.add_argument("--universe", type=int, default=0, help="15-bit Port-Address to subscribe to")
+    parser.add_argument("--bind", default="0.0.0.0", help="local address to listen on")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+    sock.setsockopt(socket.IPPROTO_IP, IP_PKTINFO, 1)
+    sock.bind((args.bind, ARTNET_PORT))
+    sock.settimeout(0.2)
+
+    replies = [poll_reply(ip, args.universe, i) for i, ip in enumerate(args.node)]
+    stats = Stats()
+    started = time.monotonic()
+    print("Emulating %d node(s) on universe %d, waiting for ArtPoll..." % (len(args.node), args.universe))
+
+    while True:
+        try:
+            data, ancdata, _, sender = sock.recvmsg(1024, socket.CMSG_SPACE(12))
+        except socket.timeout:
+            data = None
+        now = time.monotonic()
+
+        if data and len(data) >= 10 and data[0:8] == ARTNET_ID:
+            opcode = struct.unpack_from("<H", data, 8)[0]
+            # in_pktinfo: ifindex, local address, destination address
+            node = "?"
+            for level, kind, value in ancdata:
+                if level == socket.IPPROTO_IP and kind == IP_PKTINFO:
+                    node = socket.inet_ntoa(value[8:12])
+            if node not in args.node:
+                node = "broadcast"
+
+            if opcode == OP_POLL:
+                stats.polls += 1
+                for reply in replies:
+                    sock.sendto(reply, sender)
+            elif opcode == OP_DMX and len(data) >= 18:
+                universe = data[14] | ((data[15] & 0x7F) << 8)
+                if universe == args.universe:
+                    stats.on_dmx(node, data[12], now)
+            elif opcode == OP_SYNC:
+                stats.on_sync(now, len(args.node))
+
+        if now - started >= 1.0:
+            stats.report(now - started)
+            stats.reset()
+            started = now
+
+
+main()
@@ -0,0 +1,113 @@
+# Compiles the web interface in data/ into the firmware.
+#
+# Every file is gzipped and written to src/web_assets.h as a byte array with
+# its content type and a strong ETag (hash of the compressed bytes), so the
+# firmware can serve it straight from flash without touching SPIFFS.
+#
+# URLs are the plain data/ paths, not content-hashed, so browsers must
+# revalidate on every load: that costs a bodyless 304 until the firmware
+# (and with it the WebSocket protocol) changes.
+#
+# Runs as a PlatformIO pre-build script (see platformio.ini), or standalone:
+#   python tools/embed_web.py
+
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")  # noqa: F821 (provided by PlatformIO/SCons)
+    PROJECT_DIR = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+DATA_DIR = os.path.join(PROJECT_DIR, "data")
+OUTPUT = os.path.join(PROJECT_DIR, "src", "web_assets.h")
+
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+}
+
+CACHE_CONTROL = "no-cache"
+
+
+def collect_assets():
+    assets = []
+    for root, _, files in os.walk(DATA_DIR):
+        for name in sorted(files):
+            path = os.path.join(root, name)
+            url = "/" + os.path.relpath(path, DATA_DIR).replace(os.sep, "/")
+            ext = os.path.splitext(name)[1].lower()
+            with open(path, "rb") as f:
+                raw = f.read()
+            # mtime=0 keeps the output (and so the ETag) reproducible
+            compressed = gzip.compress(raw, compresslevel=9, mtime=0)
+            assets.append({
+                "url": url,
+                "type": CONTENT_TYPES.get(ext, "application/octet-stream"),
+                "cache": CACHE_CONTROL,
+                "etag": hashlib.sha256(compressed).hexdigest()[:16],
+                "raw": len(raw),
+                "data": compressed,
+            })
+    assets.sort(key=lambda a: a["url"])
+    return assets
+
+
+def render(assets):
+    out = [
+        "// Generated by tools/embed_web.py from data/, do not edit",
+        "#pragma once",
+        "#include <Arduino.h>",
+        "",
+        "struct WebAsset {",
+        "    const char* path;",
+        "    const char* contentType;",
+        "    const char* etag;",
+        "    const char* cacheControl;",
+        "    const uint8_t* data;  // gzip compressed",
+        "    size_t length;",
+        "};",
+        "",
+    ]
+    for i, asset in enumerate(assets):
+        out.append("// %s: %d bytes, %d gzipped" % (asset["url"], asset["raw"], len(asset["data"])))
+        out.append("static const uint8_t WEB_ASSET_%d[] PROGMEM = {" % i)
+        data = asset["data"]
+        for off in range(0, len(data), 16):
+            out.append("    " + ", ".join("0x%02x" % b for b in data[off:off + 16]) + ",")
+        out.append("};")
+        out.append("")
+    out.append("static const WebAsset webAssets[] = {")
+    for i, asset in enumerate(assets):
+        out.append('    {"%s", "%s", "\\"%s\\"", "%s", WEB_ASSET_%d, sizeof(WEB_ASSET_%d)},' % (
+            asset["url"], asset["type"], asset["etag"], asset["cache"], i, i))
+    out.append("};")
+    out.append("static const size_t webAssetCount = sizeof(webAssets) / sizeof(webAssets[0]);")
+    out.append("")
+    return "\n".join(out)
+
+
+def main():
+    assets = collect_assets()
+    header = render(assets)
+    # Only rewrite on change so unchanged UIs do not trigger a rebuild
+    current = None
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT) as f:
+            current = f.read()
+    if current != header:
+        with open(OUTPUT, "w") as f:
+            f.write(header)
+    for asset in assets:
+        print("Embedded %s: %d -> %d bytes (gzip), ETag \"%s\"" % (
+            asset["url"], asset["raw"], len(asset["data"]), asset["etag"]))
+
+
+main()
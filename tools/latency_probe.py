@@ -0,0 +1,149 @@
+# Command-to-wire latency probe for the DMX refresh modes.
+#
+# Connects to the device's WebSocket, selects each DMX refresh mode in turn
+# (fixed 40 Hz, continuous, change-driven) and sends a series of colour
+# commands at a jittered interval, so they land at random points of the
+# refresh cycle. Selecting a mode resets the device's latency counters; after
+# the series the script reads them back from the status:
+#   - wire: command arriving on the device until the last slot of the first
+#     DMX frame carrying it is out (measured on the device with micros())
+#   - status: host round trip from sending the command until a status message
+#     shows the new colour (includes WiFi both ways, not the DMX wire)
+#
+# The mode that was active before is restored at the end. Usage:
+#   python tools/latency_probe.py --host 192.168.1.42
+#   python tools/latency_probe.py --host 192.168.1.42 --count 200 --mode change
+
+import argparse
+import base64
+import json
+import os
+import random
+import socket
+import struct
+import time
+
+MODES = {"fixed": 0, "continuous": 1, "change": 2}
+
+
+class WebSocket:
+    """Just enough of RFC 6455 for text frames to and from the device."""
+
+    def __init__(self, host, port, path):
+        self.sock = socket.create_connection((host, port), timeout=5)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall(("GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                           "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n" % (path, host, key)).encode())
+        response = b""
+        while b"\r\n\r\n" not in response:
+            chunk = self.sock.recv(1024)
+            if not chunk:
+                raise ConnectionError("connection closed during handshake")
+            response += chunk
+        head, self.buffer = response.split(b"\r\n\r\n", 1)
+        if b" 101 " not in head.split(b"\r\n", 1)[0]:
+            raise ConnectionError("upgrade refused: %s" % head.split(b"\r\n", 1)[0].decode())
+
+    def send(self, message):
+        payload = json.dumps(message, separators=(",", ":")).encode()
+        mask = os.urandom(4)
+        header = bytes([0x81])
+        if len(payload) < 126:
+            header += bytes([0x80 | len(payload)])
+        else:
+            header += bytes([0x80 | 126]) + struct.pack(">H", len(payload))
+        masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+        self.sock.sendall(header + mask + masked)
+
+    def _read(self, count):
+        while len(self.buffer) < count:
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                raise ConnectionError("connection closed")
+            self.buffer += chunk
+        data, self.buffer = self.buffer[:count], self.buffer[count:]
+        return data
+
+    def receive(self, timeout):
+        """Next text message as parsed JSON, or None on timeout."""
+        self.sock.settimeout(timeout)
+        try:
+            while True:
+                first, second = self._read(2)
+                length = second & 0x7F
+                if length == 126:
+                    length = struct.unpack(">H", self._read(2))[0]
+                elif length == 127:
+                    length = struct.unpack(">Q", self._read(8))[0]
+                payload = self._read(length)
+                opcode = first & 0x0F
+                if opcode == 0x1:
+                    return json.loads(payload)
+                if opcode == 0x8:
+                    raise ConnectionError("device closed the WebSocket")
+        except socket.timeout:
+            return None
+
+    def drain(self, seconds):
+        """Read messages for a while, return the last status seen."""
+        last = None
+        end = time.monotonic() + seconds
+        while time.monotonic() < end:
+            message = self.receive(max(0.01, end - time.monotonic()))
+            if message is not None:
+                last = message
+        return last
+
+
+def summary(values):
+    if not values:
+        return "-"
+    values = sorted(values)
+    return "avg %.1f / p95 %.1f / max %.1f ms" % (
+        sum(values) / len(values), values[int(0.95 * (len(values) - 1))], values[-1])
+
+
+def probe(ws, mode, count, interval):
+    ws.send({"dmxMode": MODES[mode]})
+    ws.drain(0.5)
+    round_trips = []
+    for i in range(count):
+        red = 255 if i % 2 == 0 else 0  # Alternate, so every command changes the frame
+        sent = time.monotonic()
+        ws.send({"color": {"r": red, "g": 0, "b": 0}})
+        while True:
+            status = ws.receive(max(0.01, sent + 2.0 - time.monotonic()))
+            if status is None:
+                break
+            if status.get("color", {}).get("r") == red:
+                round_trips.append(1000 * (time.monotonic() - sent))
+                break
+        ws.drain(random.uniform(0.8, 1.2) * interval)
+    status = ws.drain(1.5)  # Picks up the periodic status with the final counters
+    if not status or "cmdLatencyCount" not in status:
+        print("%-10s | no latency counters in the status (firmware too old?)" % mode)
+        return
+    print("%-10s | wire avg %.1f / max %.1f ms over %d frames | status %s | dmx %d Hz" % (
+        mode, status["cmdLatencyAvg"] / 1000, status["cmdLatencyMax"] / 1000, status["cmdLatencyCount"],
+        summary(round_trips), status.get("dmxRate", 0)), flush=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure command-to-wire latency per DMX refresh mode")
+    parser.add_argument("--host", required=True, help="device address")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--count", type=int, default=100, help="commands per mode")
+    parser.add_argument("--interval", type=float, default=0.1, help="average seconds between commands")
+    parser.add_argument("--mode", choices=list(MODES), action="append", help="mode to test (repeatable, default all)")
+    args = parser.parse_args()
+
+    ws = WebSocket(args.host, args.port, "/ws")
+    initial = ws.drain(1.5)
+    for mode in args.mode or list(MODES):
+        probe(ws, mode, args.count, args.interval)
+    if initial and "dmxMode" in initial:
+        ws.send({"dmxMode": initial["dmxMode"]})
+        ws.drain(0.2)
+
+
+main()
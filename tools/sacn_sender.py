@@ -0,0 +1,176 @@
+# Test sender for the sACN (E1.31) receiver.
+#
+# Streams E1.31 data packets for one universe at a fixed rate, optionally
+# followed by a universe synchronization packet per frame, and reports the
+# packets/s actually achieved once per second. CID, priority, starting
+# sequence number and sync address are configurable, so several instances
+# can play competing sources. Channel 1 carries a frame counter; with
+# --latency the script also listens for the device's Art-Net output (enable
+# Art-Net output mode) and reports the time from sending a frame until that
+# counter shows up in an ArtDmx packet.
+#
+# On exit the stream is terminated properly (three packets with the Stream
+# Terminated option set). Usage:
+#   python tools/sacn_sender.py --universe 1 --rate 44 --priority 100
+#   python tools/sacn_sender.py --universe 1 --sync 7 --latency
+
+import argparse
+import socket
+import struct
+import time
+import uuid
+
+SACN_PORT = 5568
+ARTNET_PORT = 6454
+ACN_ID = b"ASC-E1.17\x00\x00\x00"
+VECTOR_ROOT_DATA = 0x00000004
+VECTOR_ROOT_EXTENDED = 0x00000008
+VECTOR_FRAMING_DATA = 0x00000002
+VECTOR_FRAMING_SYNC = 0x00000001
+OPTION_TERMINATED = 0x40
+
+
+def multicast_address(universe):
+    return "239.255.%d.%d" % (universe >> 8, universe & 0xFF)
+
+
+def flags_length(length):
+    return 0x7000 | length
+
+
+def data_packet(cid, name, priority, sync, sequence, options, universe, slots):
+    length = 126 + len(slots)
+    packet = bytearray(length)
+    # Root layer
+    struct.pack_into(">HH12sHI16s", packet, 0, 0x0010, 0x0000, ACN_ID,
+                     flags_length(length - 16), VECTOR_ROOT_DATA, cid)
+    # Framing layer
+    struct.pack_into(">HI64sBHBBH", packet, 38, flags_length(length - 38), VECTOR_FRAMING_DATA,
+                     name, priority, sync, sequence, options, universe)
+    # DMP layer: start code 0 followed by the slots
+    struct.pack_into(">HBBHHHB", packet, 115, flags_length(length - 115), 0x02, 0xA1,
+                     0x0000, 0x0001, len(slots) + 1, 0x00)
+    packet[126:] = slots
+    return bytes(packet)
+
+
+def sync_packet(cid, sequence, sync):
+    packet = bytearray(49)
+    struct.pack_into(">HH12sHI16s", packet, 0, 0x0010, 0x0000, ACN_ID,
+                     flags_length(49 - 16), VECTOR_ROOT_EXTENDED, cid)
+    struct.pack_into(">HIBH", packet, 38, flags_length(49 - 38), VECTOR_FRAMING_SYNC, sequence, sync)
+    return bytes(packet)
+
+
+def summary(values):
+    if not values:
+        return "-"
+    values = sorted(values)
+    return "avg %.1f / p95 %.1f / max %.1f ms" % (
+        1000 * sum(values) / len(values), 1000 * values[int(0.95 * (len(values) - 1))], 1000 * values[-1])
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Send an E1.31 stream and measure rate and latency")
+    parser.add_argument("--universe", type=int, default=1)
+    parser.add_argument("--rate", type=float, default=44.0, help="frames per second")
+    parser.add_argument("--channels", type=int, default=512)
+    parser.add_argument("--priority", type=int, default=100)
+    parser.add_argument("--cid", default=None, help="source CID as a UUID (random by default)")
+    parser.add_argument("--name", default="dmxthing sacn_sender")
+    parser.add_argument("--sequence", type=int, default=0, help="first sequence number")
+    parser.add_argument("--sync", type=int, default=0, help="sync address; sends a sync packet per frame")
+    parser.add_argument("--dest", default=None, help="unicast to this address instead of multicast")
+    parser.add_argument("--interface", default=None, help="local address for multicast output")
+    parser.add_argument("--duration", type=float, default=0, help="seconds to run, 0 = until Ctrl-C")
+    parser.add_argument("--latency", action="store_true", help="measure latency via the device's Art-Net output")
+    args = parser.parse_args()
+
+    cid = uuid.UUID(args.cid).bytes if args.cid else uuid.uuid4().bytes
+    name = args.name.encode()[:63]
+    data_dest = (args.dest or multicast_address(args.universe), SACN_PORT)
+    sync_dest = (args.dest or multicast_address(args.sync), SACN_PORT)
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 4)
+    if args.interface:
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton(args.interface))
+
+    listener = None
+    if args.latency:
+        listener = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        listener.bind(("0.0.0.0", ARTNET_PORT))
+        listener.setblocking(False)
+
+    sequence = args.sequence & 0xFF
+    sync_sequence = 0
+    slots = bytearray(args.channels)
+    sent_at = {}  # counter value -> send time of the frame that carried it
+    latencies = []
+    packets = 0
+    frames = 0
+    late = []
+    interval = 1.0 / args.rate
+    started = time.monotonic()
+    next_frame = started
+    window = started
+    print("Sending universe %d to %s:%d at %.1f Hz, CID %s, priority %d" % (
+        args.universe, data_dest[0], data_dest[1], args.rate, uuid.UUID(bytes=cid), args.priority), flush=True)
+
+    try:
+        while not args.duration or time.monotonic() - started < args.duration:
+            now = time.monotonic()
+            if now >= next_frame:
+                late.append(now - next_frame)
+                counter = frames & 0xFF
+                slots[0] = counter
+                sock.sendto(data_packet(cid, name, args.priority, args.sync, sequence, 0, args.universe, slots), data_dest)
+                sent_at[counter] = time.monotonic()
+                packets += 1
+                sequence = (sequence + 1) & 0xFF
+                if args.sync:
+                    sock.sendto(sync_packet(cid, sync_sequence, args.sync), sync_dest)
+                    sync_sequence = (sync_sequence + 1) & 0xFF
+                    packets += 1
+                frames += 1
+                next_frame += interval
+                if next_frame < now:
+                    next_frame = now + interval  # Fell behind, do not burst to catch up
+
+            if listener:
+                try:
+                    while True:
+                        data = listener.recv(1024)
+                        if len(data) > 18 and data[0:8] == b"Art-Net\x00" and data[8:10] == b"\x00\x50":
+                            sent = sent_at.pop(data[18], None)
+                            if sent is not None:
+                                latencies.append(time.monotonic() - sent)
+                except BlockingIOError:
+                    pass
+
+            if now - window >= 1.0:
+                elapsed = now - window
+                line = "sent %6.1f pkt/s | frames %5.1f/s | send late %s" % (
+                    packets / elapsed, frames / elapsed, summary(late))
+                if listener:
+                    line += " | latency %s" % summary(latencies)
+                print(line, flush=True)
+                packets = 0
+                frames = 0
+                late = []
+                latencies = []
+                window = now
+
+            time.sleep(min(0.0005, max(0.0, next_frame - time.monotonic())))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        # E1.31 6.2.6: announce termination with three packets
+        for _ in range(3):
+            sock.sendto(data_packet(cid, name, args.priority, args.sync, sequence, OPTION_TERMINATED,
+                                    args.universe, slots), data_dest)
+            sequence = (sequence + 1) & 0xFF
+
+
+main()